@@ -0,0 +1,62 @@
+
+/* The following structures handle a list of priority queues that lives in a
+   named POSIX shared-memory segment, so that several processes can attach to
+   it and operate on the same queues. Every process maps the segment at a
+   different address, so the links between nodes are offsets from the start
+   of the segment instead of pointers. An offset of 0 plays the role of NULL,
+   since offset 0 is always the header and never a node.
+
+   The segment starts with a header that holds a process-shared, robust mutex
+   and the head of the list of queues. Right after the header comes a fixed
+   number of blocks. Each block is either an element of a priority queue, a node of
+   the list of queues, or a free block waiting to be reused. Names are stored
+   inside the blocks because memory from malloc can not be shared.*/
+
+#if !defined(QUEUE_PRIO_SHM_DATASTRUCTURE_H)
+#define QUEUE_PRIO_SHM_DATASTRUCTURE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* Longest name (including the null character) that fits in a block.*/
+#define SHM_NAME_MAX 64
+/* Written in the header once the segment is fully initialized.*/
+#define SHM_MAGIC 0x51505253u
+
+typedef size_t Shm_Offset;
+
+typedef struct shm_node {
+  char name[SHM_NAME_MAX];
+  unsigned int priority;
+  Shm_Offset next;
+} Shm_Node;
+
+typedef struct shm_q_node {
+  char name[SHM_NAME_MAX];
+  Shm_Offset head;
+  Shm_Offset next_q;
+} Shm_Q_Node;
+
+typedef union shm_block {
+  Shm_Node node;
+  Shm_Q_Node q_node;
+  Shm_Offset next_free;
+} Shm_Block;
+
+typedef struct shm_header {
+  unsigned int magic;
+  pthread_mutex_t lock;
+  size_t num_blocks;
+  size_t used_blocks;
+  Shm_Offset free_list;
+  Shm_Offset head_q;
+} Shm_Header;
+
+/* This struct is private to each process. It remembers where the segment
+   was mapped in this process and how long the mapping is.*/
+typedef struct shm_queue_prio_list {
+  Shm_Header *base;
+  size_t length;
+} Shm_Queue_prio_list;
+
+#endif
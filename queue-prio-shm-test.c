@@ -0,0 +1,157 @@
+
+/* Tests for the shared-memory list of priority queues. A forked process
+   uses the same queues as its parent, a full segment refuses new elements,
+   and a process that dies holding the lock must not lose any blocks. The
+   segment name includes the process id, so several runs can happen at the
+   same time. Build it together with queue-prio-shm.c and -lpthread.*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "queue-prio-shm.h"
+#include "queue-prio-test.h"
+
+/* Name of the segment used by this run, filled in by main.*/
+static char shm_test_name[64];
+
+/* This function checks that de-queuing from the queue with the name of its
+   second parameter returns the name of its third parameter.*/
+static void check_de_queue(Shm_Queue_prio_list *const shm_list,
+			   const char queue_name[], const char expected[]) {
+  char *name = shm_de_queue(shm_list, queue_name);
+
+  CHECK(name != NULL);
+  CHECK(strcmp(name, expected) == 0);
+  free(name);
+}
+
+/* This function waits for the child process and checks that it exited
+   normally with status 0.*/
+static void check_child(pid_t pid) {
+  int status = 0;
+
+  CHECK(waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/* A child process attaches to the segment and adds elements that the parent
+   then removes, and the other way around.*/
+static void test_two_processes(void) {
+  Shm_Queue_prio_list parent, child;
+  size_t num_blocks = 0;
+  pid_t pid;
+
+  CHECK(shm_create_queue_list(&parent, shm_test_name, 16));
+  CHECK(!shm_create_queue_list(&child, shm_test_name, 16));
+  CHECK(shm_add_queue_prio(&parent, "jobs"));
+  CHECK(!shm_add_queue_prio(&parent, "jobs"));
+  CHECK(shm_en_queue(&parent, "jobs", "from-parent", 7));
+
+  pid = fork();
+  CHECK(pid != -1);
+  if (pid == 0) {
+    CHECK(shm_attach_queue_list(&child, shm_test_name));
+    CHECK(shm_num_queues(&child) == 1);
+    check_de_queue(&child, "jobs", "from-parent");
+    CHECK(shm_en_queue(&child, "jobs", "low", 5));
+    CHECK(shm_en_queue(&child, "jobs", "high", 3000000000u));
+    CHECK(shm_en_queue(&child, "jobs", "middle", 9));
+    CHECK(!shm_en_queue(&child, "jobs", "same", 9));
+    CHECK(shm_detach_queue_list(&child));
+    exit(0);
+  }
+  check_child(pid);
+
+  /* The elements come out in descending order of priority.*/
+  CHECK(shm_size(&parent, "jobs") == 3);
+  check_de_queue(&parent, "jobs", "high");
+  check_de_queue(&parent, "jobs", "middle");
+  check_de_queue(&parent, "jobs", "low");
+  CHECK(shm_de_queue(&parent, "jobs") == NULL);
+  CHECK(shm_de_queue(&parent, "missing") == NULL);
+
+  /* A header that claims so many blocks that their size wraps around must
+     not be attached to.*/
+  num_blocks = parent.base->num_blocks;
+  parent.base->num_blocks = (size_t) -1 / sizeof(Shm_Block) + 1;
+  CHECK(!shm_attach_queue_list(&child, shm_test_name));
+  parent.base->num_blocks = num_blocks;
+  CHECK(shm_attach_queue_list(&child, shm_test_name));
+  CHECK(shm_detach_queue_list(&child));
+
+  CHECK(shm_detach_queue_list(&parent));
+  CHECK(shm_unlink_queue_list(shm_test_name));
+}
+
+/* A segment with 6 blocks is filled up, then a child process dies while
+   holding the lock after losing the free blocks. The next process to lock
+   the segment must give all the unused blocks back.*/
+static void test_owner_dies(void) {
+  Shm_Queue_prio_list parent, child;
+  char *name = NULL;
+  pid_t pid;
+
+  CHECK(shm_create_queue_list(&parent, shm_test_name, 6));
+  CHECK(shm_add_queue_prio(&parent, "jobs"));
+  CHECK(shm_en_queue(&parent, "jobs", "a", 1));
+  CHECK(shm_en_queue(&parent, "jobs", "b", 2));
+  CHECK(shm_en_queue(&parent, "jobs", "c", 3));
+  CHECK(shm_en_queue(&parent, "jobs", "d", 4));
+  CHECK(shm_en_queue(&parent, "jobs", "e", 5));
+  CHECK(!shm_en_queue(&parent, "jobs", "f", 6));
+  check_de_queue(&parent, "jobs", "e");
+  check_de_queue(&parent, "jobs", "d");
+
+  pid = fork();
+  CHECK(pid != -1);
+  if (pid == 0) {
+    CHECK(shm_attach_queue_list(&child, shm_test_name));
+    CHECK(pthread_mutex_lock(&child.base->lock) == 0);
+    /* Lose the two free blocks and make it look like every block is in
+       use, then die without unlocking.*/
+    child.base->free_list = 0;
+    child.base->used_blocks = child.base->num_blocks;
+    exit(0);
+  }
+  check_child(pid);
+
+  /* The queue is intact, and the two lost blocks can be used again.*/
+  CHECK(shm_size(&parent, "jobs") == 3);
+  CHECK(shm_en_queue(&parent, "jobs", "g", 7));
+  CHECK(shm_en_queue(&parent, "jobs", "h", 8));
+  CHECK(!shm_en_queue(&parent, "jobs", "i", 9));
+  check_de_queue(&parent, "jobs", "h");
+
+  /* Removing the queue gives all of its blocks back.*/
+  CHECK(shm_remove_queue(&parent, "jobs") == 1);
+  CHECK(shm_remove_queue(&parent, "jobs") == 0);
+  CHECK(shm_num_queues(&parent) == 0);
+  CHECK(shm_add_queue_prio(&parent, "again"));
+  CHECK(shm_en_queue(&parent, "again", "1", 1));
+  CHECK(shm_en_queue(&parent, "again", "2", 2));
+  CHECK(shm_en_queue(&parent, "again", "3", 3));
+  CHECK(shm_en_queue(&parent, "again", "4", 4));
+  CHECK(shm_en_queue(&parent, "again", "5", 5));
+  CHECK(!shm_en_queue(&parent, "again", "6", 6));
+  name = shm_peek(&parent, "again");
+  CHECK(name != NULL && strcmp(name, "5") == 0);
+  free(name);
+
+  CHECK(shm_detach_queue_list(&parent));
+  CHECK(shm_unlink_queue_list(shm_test_name));
+}
+
+int main(void) {
+  sprintf(shm_test_name, "/queue-prio-shm-test-%ld", (long) getpid());
+
+  test_two_processes();
+  test_owner_dies();
+
+  printf("All shared-memory queue tests passed.\n");
+
+  return 0;
+}
@@ -0,0 +1,571 @@
+
+/* The following functions operate upon a list of priority queues that is
+   placed in a named POSIX shared-memory segment. One process creates the
+   segment, then any number of processes attach to it and add or remove
+   elements directly, without copying them through another process.
+
+   All operations take the robust mutex in the header. If a process dies
+   while holding it, the next process that locks it is told so, and it
+   rebuilds the list of free blocks before continuing. This is enough to
+   recover because every operation links a node into a list, or unlinks it,
+   with one single store, so the queues are always in a valid state and only
+   blocks that were being allocated or freed can be lost.*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "queue-prio-shm.h"
+
+/* Size of the segment needed to hold the header and capacity blocks.*/
+#define SHM_LENGTH(CAPACITY) \
+  (sizeof(Shm_Header) + (size_t) (CAPACITY) * sizeof(Shm_Block))
+
+/* This function returns a pointer to the first block, which comes right
+   after the header.*/
+static Shm_Block *shm_blocks(Shm_Header *const base) {
+  return (Shm_Block *) ((char *) base + sizeof(Shm_Header));
+}
+
+/* This function returns a pointer to the block at the offset that its second
+   parameter indicates, or null if the offset is 0.*/
+static Shm_Block *shm_block_at(Shm_Header *const base, Shm_Offset offset) {
+  Shm_Block *block = NULL;
+
+  if (offset != 0)
+    block = (Shm_Block *) ((char *) base + offset);
+
+  return block;
+}
+
+/* This function returns the offset of a block from the start of the segment.*/
+static Shm_Offset shm_offset_of(Shm_Header *const base, Shm_Block *block) {
+  return (Shm_Offset) ((char *) block - (char *) base);
+}
+
+/* This function stores a new offset in a link. All the stores that filled in
+   a new node are guaranteed to happen before this one, so a process that dies
+   right after it never leaves a half written node in a queue.*/
+static void shm_publish(Shm_Offset *link, Shm_Offset offset) {
+  __atomic_store_n(link, offset, __ATOMIC_RELEASE);
+}
+
+/* This function takes a block from the list of free blocks, or a block that
+   has never been used if that list is empty. It returns null if all blocks
+   are in use.*/
+static Shm_Block *shm_alloc_block(Shm_Header *const base) {
+  Shm_Block *block = NULL;
+
+  if (base->free_list != 0) {
+    block = shm_block_at(base, base->free_list);
+    shm_publish(&base->free_list, block->next_free);
+  }
+  else if (base->used_blocks < base->num_blocks) {
+    block = &shm_blocks(base)[base->used_blocks];
+    base->used_blocks++;
+  }
+
+  return block;
+}
+
+/* This function puts a block back in the list of free blocks.*/
+static void shm_free_block(Shm_Header *const base, Shm_Block *block) {
+  block->next_free = base->free_list;
+  shm_publish(&base->free_list, shm_offset_of(base, block));
+}
+
+/* This function is called when the process that held the lock died. It marks
+   every block that can still be reached from the list of queues, then builds
+   a new list of free blocks out of all the other blocks, so the count of
+   blocks that were ever used does not need to be trusted. If the memory for
+   the marks can not be allocated, the old free list is kept, which is still
+   valid but may have lost a few blocks.*/
+static void shm_recover(Shm_Header *const base) {
+  unsigned char *reachable = NULL;
+  Shm_Block *q = NULL, *curr = NULL;
+  size_t i = 0;
+
+  reachable = calloc(base->num_blocks, sizeof(*reachable));
+
+  if (reachable != NULL) {
+    /* Go through every queue, and every element of each queue.*/
+    q = shm_block_at(base, base->head_q);
+    while (q != NULL) {
+      reachable[q - shm_blocks(base)] = 1;
+      curr = shm_block_at(base, q->q_node.head);
+      while (curr != NULL) {
+	reachable[curr - shm_blocks(base)] = 1;
+	curr = shm_block_at(base, curr->node.next);
+      }
+      q = shm_block_at(base, q->q_node.next_q);
+    }
+
+    /* Every block that is not reachable is free. Going backwards keeps the
+       free list in increasing order.*/
+    base->free_list = 0;
+    for (i = base->num_blocks; i > 0; i--)
+      if (!reachable[i - 1])
+	shm_free_block(base, &shm_blocks(base)[i - 1]);
+    base->used_blocks = base->num_blocks;
+
+    free(reachable);
+  }
+}
+
+/* This function locks the segment. It returns 1 if the lock was taken, and 0
+   if the lock can not be used anymore.*/
+static short shm_lock(Shm_Header *const base) {
+  int rc = pthread_mutex_lock(&base->lock);
+
+  /* The previous owner died while holding the lock, so repair the segment
+     and mark the lock as usable again. If that fails, the lock is still
+     held, so release it. It then can not be used anymore, and the next
+     processes that try to lock it fail instead of waiting forever.*/
+  if (rc == EOWNERDEAD) {
+    shm_recover(base);
+    rc = pthread_mutex_consistent(&base->lock);
+    if (rc != 0)
+      pthread_mutex_unlock(&base->lock);
+  }
+
+  return rc == 0;
+}
+
+static void shm_unlock(Shm_Header *const base) {
+  pthread_mutex_unlock(&base->lock);
+}
+
+/* This function returns the node of the queue with the name of its second
+   parameter, or null if there is no queue with that name. The caller must
+   hold the lock.*/
+static Shm_Block *shm_find_queue(Shm_Header *const base,
+				 const char queue_name[]) {
+  Shm_Block *curr = shm_block_at(base, base->head_q);
+
+  while (curr != NULL && strcmp(curr->q_node.name, queue_name) != 0)
+    curr = shm_block_at(base, curr->q_node.next_q);
+
+  return curr;
+}
+
+/* This function creates a new shared-memory segment with the name of its
+   second parameter, with room for as many elements and queues together as
+   the third parameter indicates, and maps it into this process. It returns
+   1 on success and 0 if the parameters are invalid or if the segment can
+   not be created (for instance because one with that name already exists).
+
+   If the creating process dies before it finishes, the name stays taken by
+   a segment that can never be attached to. This function can not replace
+   it, since another process may still be creating it, so whoever knows the
+   creator is gone has to call shm_unlink_queue_list and create it again.*/
+short shm_create_queue_list(Shm_Queue_prio_list *const shm_list,
+			    const char shm_name[], unsigned int capacity) {
+  short is_valid = 1;
+  int fd = -1;
+  size_t length = SHM_LENGTH(capacity);
+  Shm_Header *base = NULL;
+  pthread_mutexattr_t attr;
+
+  if (shm_list == NULL || shm_name == NULL || capacity == 0)
+    is_valid = 0;
+  else {
+    fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+      is_valid = 0;
+  }
+
+  /* Give the segment its size. The new memory is filled with zeros, so
+     every offset in it starts out as null.*/
+  if (is_valid) {
+    if (ftruncate(fd, (off_t) length) == -1)
+      is_valid = 0;
+    else {
+      base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED) {
+	base = NULL;
+	is_valid = 0;
+      }
+    }
+    close(fd);
+  }
+
+  /* The lock has to be shared between processes and has to tell us when
+     its owner dies.*/
+  if (is_valid) {
+    if (pthread_mutexattr_init(&attr) != 0)
+      is_valid = 0;
+    else {
+      if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) != 0
+	  || pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) != 0
+	  || pthread_mutex_init(&base->lock, &attr) != 0)
+	is_valid = 0;
+      pthread_mutexattr_destroy(&attr);
+    }
+  }
+
+  if (is_valid) {
+    base->num_blocks = capacity;
+    base->used_blocks = 0;
+    base->free_list = 0;
+    base->head_q = 0;
+    /* Other processes will not attach until they see the magic number.*/
+    __atomic_store_n(&base->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    shm_list->base = base;
+    shm_list->length = length;
+  }
+  else if (fd != -1) {
+    /* Do not leave a half created segment behind.*/
+    if (base != NULL)
+      munmap(base, length);
+    shm_unlink(shm_name);
+  }
+
+  return is_valid;
+}
+
+/* This function maps an existing segment with the name of its second
+   parameter into this process. It returns 1 on success, and 0 if the
+   segment does not exist, is damaged, or has not been fully created yet.
+   If it keeps returning 0 because its creator died, see
+   shm_create_queue_list.*/
+short shm_attach_queue_list(Shm_Queue_prio_list *const shm_list,
+			    const char shm_name[]) {
+  short is_valid = 1;
+  int fd = -1;
+  struct stat st;
+  Shm_Header *base = NULL;
+
+  if (shm_list == NULL || shm_name == NULL)
+    is_valid = 0;
+  else {
+    fd = shm_open(shm_name, O_RDWR, 0);
+    if (fd == -1)
+      is_valid = 0;
+  }
+
+  if (is_valid) {
+    /* The segment must at least be big enough to hold the header.*/
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < SHM_LENGTH(0))
+      is_valid = 0;
+    else {
+      base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED) {
+	base = NULL;
+	is_valid = 0;
+      }
+    }
+    close(fd);
+  }
+
+  /* Check that the creator has finished and that all the blocks that the
+     header talks about are really inside the mapping. The number of blocks
+     is divided into the space left instead of multiplied, so a damaged
+     header can not make the size overflow.*/
+  if (is_valid) {
+    if (__atomic_load_n(&base->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC
+	|| base->num_blocks > ((size_t) st.st_size - SHM_LENGTH(0))
+	/ sizeof(Shm_Block)) {
+      munmap(base, (size_t) st.st_size);
+      is_valid = 0;
+    }
+    else {
+      shm_list->base = base;
+      shm_list->length = (size_t) st.st_size;
+    }
+  }
+
+  return is_valid;
+}
+
+/* This function unmaps the segment from this process. The segment and the
+   queues in it stay alive for the other processes.*/
+short shm_detach_queue_list(Shm_Queue_prio_list *const shm_list) {
+  short is_valid = 1;
+
+  if (shm_list == NULL || shm_list->base == NULL)
+    is_valid = 0;
+  else {
+    munmap(shm_list->base, shm_list->length);
+    shm_list->base = NULL;
+    shm_list->length = 0;
+  }
+
+  return is_valid;
+}
+
+/* This function removes the name of the segment, so no new process can
+   attach to it. The memory is released once every process has detached.*/
+short shm_unlink_queue_list(const char shm_name[]) {
+  short is_valid = 1;
+
+  if (shm_name == NULL || shm_unlink(shm_name) == -1)
+    is_valid = 0;
+
+  return is_valid;
+}
+
+/* This function adds a new priority queue with the name of its second
+   parameter at the end of the list. It returns 0 if a queue with that name
+   already exists, if the name is too long, if there are no free blocks, or
+   if the lock can not be recovered.*/
+short shm_add_queue_prio(Shm_Queue_prio_list *const shm_list,
+			 const char new_queue_name[]) {
+  short is_valid = 1;
+  Shm_Header *base = NULL;
+  Shm_Block *curr = NULL, *new_queue_node = NULL;
+  Shm_Offset *link = NULL;
+
+  if (shm_list == NULL || shm_list->base == NULL || new_queue_name == NULL
+      || strlen(new_queue_name) >= SHM_NAME_MAX)
+    is_valid = 0;
+  else {
+    base = shm_list->base;
+    is_valid = shm_lock(base);
+  }
+
+  if (is_valid) {
+    /* Look for the last link in the list, checking the names on the way.*/
+    link = &base->head_q;
+    curr = shm_block_at(base, *link);
+    while (curr != NULL && is_valid) {
+      if (strcmp(curr->q_node.name, new_queue_name) == 0)
+	is_valid = 0;
+      link = &curr->q_node.next_q;
+      curr = shm_block_at(base, *link);
+    }
+
+    if (is_valid) {
+      new_queue_node = shm_alloc_block(base);
+      if (new_queue_node == NULL)
+	is_valid = 0;
+    }
+
+    /* Fill in the new node completely before linking it to the list.*/
+    if (is_valid) {
+      strcpy(new_queue_node->q_node.name, new_queue_name);
+      new_queue_node->q_node.head = 0;
+      new_queue_node->q_node.next_q = 0;
+      shm_publish(link, shm_offset_of(base, new_queue_node));
+    }
+
+    shm_unlock(base);
+  }
+
+  return is_valid;
+}
+
+/* This function returns the number of priority queues in the segment, or -1
+   if the parameter is null or if the lock can not be recovered.*/
+short shm_num_queues(Shm_Queue_prio_list *const shm_list) {
+  short num_queues = 0;
+  Shm_Block *curr = NULL;
+
+  if (shm_list == NULL || shm_list->base == NULL
+      || !shm_lock(shm_list->base))
+    num_queues = -1;
+  else {
+    curr = shm_block_at(shm_list->base, shm_list->base->head_q);
+    while (curr != NULL) {
+      num_queues++;
+      curr = shm_block_at(shm_list->base, curr->q_node.next_q);
+    }
+    shm_unlock(shm_list->base);
+  }
+
+  return num_queues;
+}
+
+/* This function removes the priority queue with the name of its second
+   parameter, and all of its elements, and returns 1. If any parameter is
+   null or if the lock can not be recovered, return -1. If there is no queue
+   with that name, return 0.*/
+short shm_remove_queue(Shm_Queue_prio_list *const shm_list,
+		       const char queue_to_remove[]) {
+  short removed = 1;
+  Shm_Header *base = NULL;
+  Shm_Block *curr = NULL, *track = NULL;
+  Shm_Offset *link = NULL;
+
+  if (shm_list == NULL || shm_list->base == NULL || queue_to_remove == NULL
+      || !shm_lock(shm_list->base))
+    removed = -1;
+  else {
+    base = shm_list->base;
+    link = &base->head_q;
+    curr = shm_block_at(base, *link);
+    /* Keep the link that points to the queue, so it can be unlinked.*/
+    while (curr != NULL && strcmp(curr->q_node.name, queue_to_remove) != 0) {
+      link = &curr->q_node.next_q;
+      curr = shm_block_at(base, *link);
+    }
+
+    if (curr == NULL)
+      removed = 0;
+    else {
+      /* Unlink the queue first, then give its blocks back.*/
+      shm_publish(link, curr->q_node.next_q);
+      track = shm_block_at(base, curr->q_node.head);
+      while (track != NULL) {
+	curr->q_node.head = track->node.next;
+	shm_free_block(base, track);
+	track = shm_block_at(base, curr->q_node.head);
+      }
+      shm_free_block(base, curr);
+    }
+
+    shm_unlock(base);
+  }
+
+  return removed;
+}
+
+/* This function adds a new element with the name and priority of its third
+   and fourth parameters to the queue with the name of its second parameter.
+   Like en_queue, it returns 0 if an element with the same priority is
+   already in the queue. It also returns 0 if the queue does not exist, if
+   the name is too long, if there are no free blocks, or if the lock can not
+   be recovered.*/
+unsigned short shm_en_queue(Shm_Queue_prio_list *const shm_list,
+			    const char queue_name[], const char new_element[],
+			    unsigned int priority) {
+  unsigned short is_valid = 1;
+  Shm_Header *base = NULL;
+  Shm_Block *q = NULL, *curr = NULL, *new_item = NULL;
+  Shm_Offset *link = NULL;
+
+  if (shm_list == NULL || shm_list->base == NULL || queue_name == NULL
+      || new_element == NULL || strlen(new_element) >= SHM_NAME_MAX)
+    is_valid = 0;
+  else {
+    base = shm_list->base;
+    is_valid = shm_lock(base);
+  }
+
+  if (is_valid) {
+    q = shm_find_queue(base, queue_name);
+    if (q == NULL)
+      is_valid = 0;
+    else {
+      /* The queue is in descending order, so look for the first element
+	 with a lower priority than the new one.*/
+      link = &q->q_node.head;
+      curr = shm_block_at(base, *link);
+      while (curr != NULL && priority <= curr->node.priority && is_valid) {
+	if (priority == curr->node.priority)
+	  is_valid = 0;
+	link = &curr->node.next;
+	curr = shm_block_at(base, *link);
+      }
+    }
+
+    if (is_valid) {
+      new_item = shm_alloc_block(base);
+      if (new_item == NULL)
+	is_valid = 0;
+    }
+
+    /* Fill in the new element completely before linking it to the queue.*/
+    if (is_valid) {
+      strcpy(new_item->node.name, new_element);
+      new_item->node.priority = priority;
+      new_item->node.next = *link;
+      shm_publish(link, shm_offset_of(base, new_item));
+    }
+
+    shm_unlock(base);
+  }
+
+  return is_valid;
+}
+
+/* This function returns the number of elements in the queue with the name
+   of its second parameter, or -1 if any parameter is null, if there is no
+   queue with that name, or if the lock can not be recovered.*/
+short shm_size(Shm_Queue_prio_list *const shm_list, const char queue_name[]) {
+  short size = 0;
+  Shm_Block *q = NULL, *curr = NULL;
+
+  if (shm_list == NULL || shm_list->base == NULL || queue_name == NULL
+      || !shm_lock(shm_list->base))
+    size = -1;
+  else {
+    q = shm_find_queue(shm_list->base, queue_name);
+    if (q == NULL)
+      size = -1;
+    else {
+      curr = shm_block_at(shm_list->base, q->q_node.head);
+      while (curr != NULL) {
+	size++;
+	curr = shm_block_at(shm_list->base, curr->node.next);
+      }
+    }
+    shm_unlock(shm_list->base);
+  }
+
+  return size;
+}
+
+/* This function returns a pointer to a dynamically allocated copy of the
+   name of the element with highest priority in the queue with the name of
+   its second parameter. It returns null if the queue is empty or missing,
+   or if the lock can not be recovered.*/
+char *shm_peek(Shm_Queue_prio_list *const shm_list, const char queue_name[]) {
+  char *pk = NULL;
+  Shm_Block *q = NULL, *head = NULL;
+
+  if (shm_list != NULL && shm_list->base != NULL && queue_name != NULL
+      && shm_lock(shm_list->base)) {
+    q = shm_find_queue(shm_list->base, queue_name);
+    if (q != NULL)
+      head = shm_block_at(shm_list->base, q->q_node.head);
+    /* The name has to be copied out of the segment while the lock is held.*/
+    if (head != NULL) {
+      pk = malloc(strlen(head->node.name) + 1);
+      if (pk != NULL)
+	strcpy(pk, head->node.name);
+    }
+    shm_unlock(shm_list->base);
+  }
+
+  return pk;
+}
+
+/* This function removes the element with highest priority in the queue with
+   the name of its second parameter. It returns a pointer to a dynamically
+   allocated copy of its name, which the caller has to free, or null if the
+   queue is empty or missing, or if the lock can not be recovered.*/
+char *shm_de_queue(Shm_Queue_prio_list *const shm_list,
+		   const char queue_name[]) {
+  char *rm = NULL;
+  Shm_Header *base = NULL;
+  Shm_Block *q = NULL, *track = NULL;
+
+  if (shm_list != NULL && shm_list->base != NULL && queue_name != NULL
+      && shm_lock(shm_list->base)) {
+    base = shm_list->base;
+    q = shm_find_queue(base, queue_name);
+    if (q != NULL)
+      track = shm_block_at(base, q->q_node.head);
+    /* Copy the name out first. If there is no memory for it, the element
+       stays in the queue.*/
+    if (track != NULL) {
+      rm = malloc(strlen(track->node.name) + 1);
+      if (rm != NULL) {
+	strcpy(rm, track->node.name);
+	shm_publish(&q->q_node.head, track->node.next);
+	shm_free_block(base, track);
+      }
+    }
+    shm_unlock(base);
+  }
+
+  return rm;
+}
@@ -0,0 +1,21 @@
+
+#include "queue-prio-shm-datastructure.h"
+
+short shm_create_queue_list(Shm_Queue_prio_list *const shm_list,
+                            const char shm_name[], unsigned int capacity);
+short shm_attach_queue_list(Shm_Queue_prio_list *const shm_list,
+                            const char shm_name[]);
+short shm_detach_queue_list(Shm_Queue_prio_list *const shm_list);
+short shm_unlink_queue_list(const char shm_name[]);
+short shm_add_queue_prio(Shm_Queue_prio_list *const shm_list,
+                         const char new_queue_name[]);
+short shm_num_queues(Shm_Queue_prio_list *const shm_list);
+short shm_remove_queue(Shm_Queue_prio_list *const shm_list,
+                       const char queue_to_remove[]);
+unsigned short shm_en_queue(Shm_Queue_prio_list *const shm_list,
+                            const char queue_name[], const char new_element[],
+                            unsigned int priority);
+short shm_size(Shm_Queue_prio_list *const shm_list, const char queue_name[]);
+char *shm_peek(Shm_Queue_prio_list *const shm_list, const char queue_name[]);
+char *shm_de_queue(Shm_Queue_prio_list *const shm_list,
+                   const char queue_name[]);
@@ -0,0 +1,20 @@
+
+/* The test programs include this header for the macro that checks one
+   condition. When a check fails, it prints where and which condition, then
+   ends the program with status 1, so a script can tell that it failed.*/
+
+#if !defined(QUEUE_PRIO_TEST_H)
+#define QUEUE_PRIO_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(COND) \
+  do { \
+    if (!(COND)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+      exit(1); \
+    } \
+  } while (0)
+
+#endif
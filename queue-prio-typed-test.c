@@ -0,0 +1,142 @@
+
+/* Tests for queue-prio-typed.h. The header is instantiated twice in this
+   file: as a queue of 64-bit handles, and as a queue of a struct with
+   padding that is compared with QUEUE_PRIO_T_EQUAL. This file also holds
+   the definitions of both queues, so it builds on its own.*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "queue-prio-test.h"
+
+#define QUEUE_PRIO_T_NAME handle_queue
+#define QUEUE_PRIO_T_TYPE uint64_t
+#define QUEUE_PRIO_T_IMPLEMENTATION
+#include "queue-prio-typed.h"
+
+/* There is padding after kind, so the bytes of two equal jobs may differ.*/
+typedef struct job {
+  char kind;
+  int id;
+} Job;
+
+#define QUEUE_PRIO_T_NAME job_queue
+#define QUEUE_PRIO_T_TYPE Job
+#define QUEUE_PRIO_T_EQUAL(A, B) ((A).kind == (B).kind && (A).id == (B).id)
+#define QUEUE_PRIO_T_IMPLEMENTATION
+#include "queue-prio-typed.h"
+
+/* Removes the next handle from the queue and compares it to the one that
+   should come out.*/
+static void check_next_handle(handle_queue *const queue, uint64_t expected) {
+  uint64_t handle = 0;
+
+  CHECK(handle_queue_de_queue(queue, &handle));
+  CHECK(handle == expected);
+}
+
+static void test_handle_queue(void) {
+  handle_queue queue;
+  uint64_t handle = 0;
+  unsigned int priority = 0;
+
+  CHECK(handle_queue_init(&queue));
+  CHECK(handle_queue_has_no_elements(&queue) == 1);
+  CHECK(!handle_queue_peek(&queue, &handle));
+  CHECK(!handle_queue_de_queue(&queue, &handle));
+
+  /* Priorities above INT_MAX are higher than small ones, as in Queue_prio.*/
+  CHECK(handle_queue_en_queue(&queue, 100, 5));
+  CHECK(handle_queue_en_queue(&queue, 200, 3000000000u));
+  CHECK(handle_queue_en_queue(&queue, 300, 9));
+  CHECK(handle_queue_en_queue(&queue, 400, UINT_MAX));
+  CHECK(!handle_queue_en_queue(&queue, 500, 9));
+  CHECK(handle_queue_size(&queue) == 4);
+  CHECK(handle_queue_peek(&queue, &handle) && handle == 400);
+
+  /* get_priority reports every unsigned priority exactly, gives the
+     highest one for an element that is present twice, and tells a missing
+     element apart from one stored with UINT_MAX.*/
+  CHECK(handle_queue_get_priority(&queue, 200, &priority));
+  CHECK(priority == 3000000000u);
+  CHECK(handle_queue_en_queue(&queue, 400, 1));
+  priority = 0;
+  CHECK(handle_queue_get_priority(&queue, 400, &priority));
+  CHECK(priority == UINT_MAX);
+  priority = 7;
+  CHECK(!handle_queue_get_priority(&queue, 999, &priority));
+  CHECK(priority == 7);
+  CHECK(!handle_queue_get_priority(&queue, 400, NULL));
+
+  /* change_priority fails for a duplicate, a missing element, or a taken
+     priority, and otherwise moves the element to its new place.*/
+  CHECK(!handle_queue_change_priority(&queue, 400, 2));
+  CHECK(!handle_queue_change_priority(&queue, 999, 2));
+  CHECK(!handle_queue_change_priority(&queue, 100, 9));
+  CHECK(handle_queue_change_priority(&queue, 100, 4000000000u));
+  CHECK(handle_queue_change_priority(&queue, 200, 2));
+
+  check_next_handle(&queue, 400);
+  check_next_handle(&queue, 100);
+  check_next_handle(&queue, 300);
+  check_next_handle(&queue, 200);
+  check_next_handle(&queue, 400);
+  CHECK(handle_queue_has_no_elements(&queue) == 1);
+
+  /* Removing the whole range of priorities empties the queue.*/
+  CHECK(handle_queue_en_queue(&queue, 1, 0));
+  CHECK(handle_queue_en_queue(&queue, 2, 7));
+  CHECK(handle_queue_en_queue(&queue, 3, 3000000000u));
+  CHECK(handle_queue_en_queue(&queue, 4, UINT_MAX));
+  CHECK(handle_queue_remove_elements_between(&queue, 5, 3000000000u) == 2);
+  CHECK(handle_queue_size(&queue) == 2);
+  CHECK(handle_queue_en_queue(&queue, 5, 8));
+  CHECK(handle_queue_remove_elements_between(&queue, 0, UINT_MAX) == 3);
+  CHECK(handle_queue_size(&queue) == 0);
+
+  CHECK(handle_queue_clear(&queue));
+}
+
+static void test_job_queue(void) {
+  job_queue queue;
+  Job first, second, found;
+  unsigned int priority = 0;
+
+  /* Fill the padding with different bytes, so only QUEUE_PRIO_T_EQUAL can
+     tell that the two copies of a job are equal.*/
+  memset(&first, 0xAA, sizeof(first));
+  memset(&second, 0x55, sizeof(second));
+  first.kind = second.kind = 'x';
+  first.id = second.id = 42;
+
+  CHECK(job_queue_init(&queue));
+  CHECK(job_queue_en_queue(&queue, first, 10));
+  CHECK(job_queue_get_priority(&queue, second, &priority) && priority == 10);
+  CHECK(job_queue_change_priority(&queue, second, 20));
+
+  found.kind = 'y';
+  found.id = 7;
+  CHECK(job_queue_en_queue(&queue, found, 15));
+  CHECK(!job_queue_en_queue(&queue, found, 20));
+
+  CHECK(job_queue_peek(&queue, &found));
+  CHECK(found.kind == 'x' && found.id == 42);
+  CHECK(job_queue_de_queue(&queue, &found));
+  CHECK(found.kind == 'x' && found.id == 42);
+  CHECK(job_queue_de_queue(&queue, &found));
+  CHECK(found.kind == 'y' && found.id == 7);
+  CHECK(!job_queue_de_queue(&queue, &found));
+
+  CHECK(job_queue_clear(&queue));
+}
+
+int main(void) {
+  test_handle_queue();
+  test_job_queue();
+
+  printf("All typed queue tests passed.\n");
+
+  return 0;
+}
@@ -0,0 +1,357 @@
+
+/* The following header generates a priority queue that stores a payload of
+   a fixed type inside each node, instead of a dynamically allocated name.
+   It is the same singly linked list in descending order of priority as
+   Queue_prio, but a node holds the payload itself (for instance a 64-bit
+   handle or a small struct), so adding an element does not allocate a name
+   and elements are found by comparing payloads, not with strcmp.
+
+   The queue is specialized at compile time. Before including this header,
+   define QUEUE_PRIO_T_NAME to the prefix of the generated type and
+   functions, and QUEUE_PRIO_T_TYPE to the type of the payload:
+
+     #define QUEUE_PRIO_T_NAME job_queue
+     #define QUEUE_PRIO_T_TYPE uint64_t
+     #include "queue-prio-typed.h"
+
+   This declares the types job_queue and job_queue_Node and the functions
+   job_queue_init, job_queue_en_queue, job_queue_de_queue, and so on. In
+   exactly one source file, also define QUEUE_PRIO_T_IMPLEMENTATION before
+   including it, so the functions are defined there. By default two
+   payloads are equal if their bytes are equal. For a struct with padding,
+   also define QUEUE_PRIO_T_EQUAL(A, B) where the functions are defined, to
+   compare the fields. The header can be included again with other
+   definitions to generate more queues.*/
+
+#if !defined(QUEUE_PRIO_T_NAME) || !defined(QUEUE_PRIO_T_TYPE)
+#error "define QUEUE_PRIO_T_NAME and QUEUE_PRIO_T_TYPE before this header"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(QUEUE_PRIO_TYPED_H)
+#define QUEUE_PRIO_TYPED_H
+
+/* These macros paste the prefix in front of the name of each function.*/
+#define QUEUE_PRIO_T_CAT2(A, B) A##B
+#define QUEUE_PRIO_T_CAT(A, B) QUEUE_PRIO_T_CAT2(A, B)
+#define QUEUE_PRIO_T_FN(NAME) QUEUE_PRIO_T_CAT(QUEUE_PRIO_T_NAME, NAME)
+
+#endif
+
+#define QUEUE_PRIO_T_QUEUE QUEUE_PRIO_T_NAME
+#define QUEUE_PRIO_T_NODE QUEUE_PRIO_T_FN(_Node)
+
+typedef struct QUEUE_PRIO_T_FN(_node) {
+  QUEUE_PRIO_T_TYPE payload;
+  unsigned int priority;
+  struct QUEUE_PRIO_T_FN(_node) *next;
+} QUEUE_PRIO_T_NODE;
+
+typedef struct {
+  QUEUE_PRIO_T_NODE *head;
+} QUEUE_PRIO_T_QUEUE;
+
+unsigned short QUEUE_PRIO_T_FN(_init)(QUEUE_PRIO_T_QUEUE *const queue);
+unsigned short QUEUE_PRIO_T_FN(_en_queue)(QUEUE_PRIO_T_QUEUE *const queue,
+                                          QUEUE_PRIO_T_TYPE payload,
+                                          unsigned int priority);
+short QUEUE_PRIO_T_FN(_has_no_elements)(const QUEUE_PRIO_T_QUEUE *const
+                                        queue);
+short QUEUE_PRIO_T_FN(_size)(const QUEUE_PRIO_T_QUEUE *const queue);
+unsigned short QUEUE_PRIO_T_FN(_peek)(const QUEUE_PRIO_T_QUEUE *const queue,
+                                      QUEUE_PRIO_T_TYPE *const payload);
+unsigned short QUEUE_PRIO_T_FN(_de_queue)(QUEUE_PRIO_T_QUEUE *const queue,
+                                          QUEUE_PRIO_T_TYPE *const payload);
+unsigned short QUEUE_PRIO_T_FN(_clear)(QUEUE_PRIO_T_QUEUE *const queue);
+unsigned short QUEUE_PRIO_T_FN(_get_priority)(const QUEUE_PRIO_T_QUEUE *const
+                                              queue,
+                                              QUEUE_PRIO_T_TYPE payload,
+                                              unsigned int *const priority);
+unsigned int QUEUE_PRIO_T_FN(_remove_elements_between)(QUEUE_PRIO_T_QUEUE
+                                                       *const queue,
+                                                       unsigned int low,
+                                                       unsigned int high);
+unsigned int QUEUE_PRIO_T_FN(_change_priority)(QUEUE_PRIO_T_QUEUE *const queue,
+                                               QUEUE_PRIO_T_TYPE payload,
+                                               unsigned int new_priority);
+
+#if defined(QUEUE_PRIO_T_IMPLEMENTATION)
+
+#if !defined(QUEUE_PRIO_T_EQUAL)
+#define QUEUE_PRIO_T_EQUAL(A, B) (memcmp(&(A), &(B), sizeof(A)) == 0)
+#endif
+
+/* This function initializes the priority queue that its parameter points to.
+   It returns 0 if the parameter is null, and 1 otherwise.*/
+unsigned short QUEUE_PRIO_T_FN(_init)(QUEUE_PRIO_T_QUEUE *const queue) {
+  unsigned short is_valid = 1;
+
+  if (queue == NULL)
+    is_valid = 0;
+  else
+    queue->head = NULL;
+
+  return is_valid;
+}
+
+/* This function links a node that is not in the queue at its place in
+   descending order of priority. It returns 0, without linking the node, if
+   another element already has the same priority.*/
+static unsigned short QUEUE_PRIO_T_FN(_link_node)
+     (QUEUE_PRIO_T_QUEUE *const queue, QUEUE_PRIO_T_NODE *new_item) {
+  unsigned short is_valid = 1;
+  QUEUE_PRIO_T_NODE *curr = queue->head, *prev = NULL;
+
+  while (curr != NULL && new_item->priority <= curr->priority && is_valid) {
+    if (new_item->priority == curr->priority)
+      is_valid = 0;
+    prev = curr;
+    curr = curr->next;
+  }
+
+  if (is_valid) {
+    new_item->next = curr;
+    if (prev == NULL)
+      queue->head = new_item;
+    else
+      prev->next = new_item;
+  }
+
+  return is_valid;
+}
+
+/* This function adds an element with the payload and priority of its second
+   and third parameters. Like en_queue, it returns 0 if the queue is null or
+   if an element with the same priority is already in the queue. It also
+   returns 0 if there is no memory for the new node.*/
+unsigned short QUEUE_PRIO_T_FN(_en_queue)
+     (QUEUE_PRIO_T_QUEUE *const queue, QUEUE_PRIO_T_TYPE payload,
+      unsigned int priority) {
+  unsigned short is_valid = 1;
+  QUEUE_PRIO_T_NODE *new_item = NULL;
+
+  if (queue == NULL)
+    is_valid = 0;
+  else {
+    /* The payload is copied into the node, so only one allocation is needed
+       per element.*/
+    new_item = malloc(sizeof(*new_item));
+    if (new_item == NULL)
+      is_valid = 0;
+    else {
+      new_item->payload = payload;
+      new_item->priority = priority;
+      if (!QUEUE_PRIO_T_FN(_link_node)(queue, new_item)) {
+	free(new_item);
+	is_valid = 0;
+      }
+    }
+  }
+
+  return is_valid;
+}
+
+/* This function returns 1 if the queue has no elements, 0 if it has
+   elements, and -1 if the parameter is null.*/
+short QUEUE_PRIO_T_FN(_has_no_elements)
+     (const QUEUE_PRIO_T_QUEUE *const queue) {
+  short no_elements = 0;
+
+  if (queue == NULL)
+    no_elements = -1;
+  else if (queue->head == NULL)
+    no_elements = 1;
+
+  return no_elements;
+}
+
+/* This function returns the number of elements in the queue, or -1 if the
+   parameter is null.*/
+short QUEUE_PRIO_T_FN(_size)(const QUEUE_PRIO_T_QUEUE *const queue) {
+  short size = 0;
+  QUEUE_PRIO_T_NODE *curr = NULL;
+
+  if (queue == NULL)
+    size = -1;
+  else {
+    curr = queue->head;
+    while (curr != NULL) {
+      size++;
+      curr = curr->next;
+    }
+  }
+
+  return size;
+}
+
+/* This function copies the payload of the element with highest priority to
+   the location that its second parameter points to and returns 1. It
+   returns 0 if any parameter is null or if the queue is empty.*/
+unsigned short QUEUE_PRIO_T_FN(_peek)
+     (const QUEUE_PRIO_T_QUEUE *const queue,
+      QUEUE_PRIO_T_TYPE *const payload) {
+  unsigned short is_valid = 1;
+
+  if (queue == NULL || payload == NULL || queue->head == NULL)
+    is_valid = 0;
+  else
+    *payload = queue->head->payload;
+
+  return is_valid;
+}
+
+/* This function removes the element with highest priority, copies its
+   payload to the location that its second parameter points to, and returns
+   1. It returns 0 if any parameter is null or if the queue is empty. There
+   is nothing for the caller to free.*/
+unsigned short QUEUE_PRIO_T_FN(_de_queue)
+     (QUEUE_PRIO_T_QUEUE *const queue, QUEUE_PRIO_T_TYPE *const payload) {
+  unsigned short is_valid = 1;
+  QUEUE_PRIO_T_NODE *track = NULL;
+
+  if (queue == NULL || payload == NULL || queue->head == NULL)
+    is_valid = 0;
+  else {
+    track = queue->head;
+    *payload = track->payload;
+    queue->head = track->next;
+    free(track);
+  }
+
+  return is_valid;
+}
+
+/* This function frees all the elements of the queue and leaves it empty.*/
+unsigned short QUEUE_PRIO_T_FN(_clear)(QUEUE_PRIO_T_QUEUE *const queue) {
+  unsigned short is_valid = 1;
+  QUEUE_PRIO_T_NODE *curr = NULL, *track = NULL;
+
+  if (queue == NULL)
+    is_valid = 0;
+  else {
+    curr = queue->head;
+    while (curr != NULL) {
+      track = curr;
+      curr = curr->next;
+      free(track);
+    }
+    queue->head = NULL;
+  }
+
+  return is_valid;
+}
+
+/* This function copies the priority of the element with the payload of its
+   second parameter to the location that its third parameter points to, and
+   returns 1. If the element is present more than once, the highest
+   priority is copied. It returns 0 if any pointer parameter is null or if
+   the element is not found, so every unsigned priority can be told apart
+   from a missing element.*/
+unsigned short QUEUE_PRIO_T_FN(_get_priority)
+     (const QUEUE_PRIO_T_QUEUE *const queue, QUEUE_PRIO_T_TYPE payload,
+      unsigned int *const priority) {
+  unsigned short found = 0;
+  QUEUE_PRIO_T_NODE *curr = NULL;
+
+  if (queue != NULL && priority != NULL) {
+    curr = queue->head;
+    /* The first match has the highest priority, since the list is in
+       descending order.*/
+    while (curr != NULL && !found) {
+      if (QUEUE_PRIO_T_EQUAL(curr->payload, payload)) {
+	found = 1;
+	*priority = curr->priority;
+      }
+      curr = curr->next;
+    }
+  }
+
+  return found;
+}
+
+/* This function removes all elements with a priority between the bounds
+   (inclusive) of its second and third parameters, and returns the number
+   of elements that were removed.*/
+unsigned int QUEUE_PRIO_T_FN(_remove_elements_between)
+     (QUEUE_PRIO_T_QUEUE *const queue, unsigned int low, unsigned int high) {
+  unsigned int removed_elements = 0;
+  QUEUE_PRIO_T_NODE *curr = NULL, *track = NULL, *prev = NULL;
+
+  if (queue != NULL) {
+    curr = queue->head;
+    while (curr != NULL) {
+      track = curr;
+      curr = curr->next;
+      if (track->priority >= low && track->priority <= high) {
+	if (prev != NULL)
+	  prev->next = curr;
+	else
+	  queue->head = curr;
+	free(track);
+	removed_elements++;
+      }
+      else
+	prev = track;
+    }
+  }
+
+  return removed_elements;
+}
+
+/* This function changes the priority of the element with the payload of its
+   second parameter to the third parameter, and moves the element so the
+   queue stays in descending order. Like change_priority, it returns 0 if
+   another element already has the new priority, if the element is present
+   more than once, or if it is not found.*/
+unsigned int QUEUE_PRIO_T_FN(_change_priority)
+     (QUEUE_PRIO_T_QUEUE *const queue, QUEUE_PRIO_T_TYPE payload,
+      unsigned int new_priority) {
+  unsigned int is_valid = 1, times_in_queue = 0;
+  QUEUE_PRIO_T_NODE *curr = NULL, *prev = NULL, *found = NULL,
+    *found_prev = NULL;
+
+  if (queue == NULL)
+    is_valid = 0;
+  else {
+    /* Check all the conditions in one pass, remembering where the element
+       is so it can be unlinked.*/
+    curr = queue->head;
+    while (curr != NULL && is_valid) {
+      if (curr->priority == new_priority)
+	is_valid = 0;
+      if (QUEUE_PRIO_T_EQUAL(curr->payload, payload)) {
+	times_in_queue++;
+	found = curr;
+	found_prev = prev;
+      }
+      prev = curr;
+      curr = curr->next;
+    }
+    if (times_in_queue != 1)
+      is_valid = 0;
+  }
+
+  /* Unlink the element and link it again at the place of its new priority.
+     No other element has that priority, so linking it can not fail.*/
+  if (is_valid) {
+    if (found_prev == NULL)
+      queue->head = found->next;
+    else
+      found_prev->next = found->next;
+    found->priority = new_priority;
+    QUEUE_PRIO_T_FN(_link_node)(queue, found);
+  }
+
+  return is_valid;
+}
+
+#endif
+
+#undef QUEUE_PRIO_T_IMPLEMENTATION
+#undef QUEUE_PRIO_T_QUEUE
+#undef QUEUE_PRIO_T_NODE
+#undef QUEUE_PRIO_T_EQUAL
+#undef QUEUE_PRIO_T_TYPE
+#undef QUEUE_PRIO_T_NAME